@@ -0,0 +1,30 @@
+#ifndef CYUSB_BITVEC_H
+#define CYUSB_BITVEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+static inline void
+bit_set(uint8_t *vec, unsigned int i) {
+    vec[i >> 3] |=  (1 << (i & 7));
+}
+
+static inline void
+bit_clr(uint8_t *vec, unsigned int i) {
+    vec[i >> 3] &= ~(1 << (i & 7));
+}
+
+static inline bool
+bit_get(uint8_t *vec, unsigned int i) {
+    return !!(vec[i >> 3] & (1 << (i & 7)));
+}
+
+static inline uint8_t
+bit_rev(uint8_t b) {
+    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+    return b;
+}
+
+#endif
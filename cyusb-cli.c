@@ -0,0 +1,83 @@
+/*
+ * Helpers shared by command line tools.
+ */
+
+#ifndef WIN32
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#endif
+
+#include "cyusb-cli.h"
+
+char *
+basename(char *p) {
+    char *pn = p;
+    char *ps;
+
+    ps = strrchr(p, '/');
+    if (pn < ps) pn = ps + 1;
+    ps = strrchr(p, '\\');
+    if (pn < ps) pn = ps + 1;
+    return pn;
+}
+
+void
+show_device(CY_DEVICE_INFO *info, void *data) {
+    printf("=====\n");
+    printf("vid=0x%.4X\n", info->vidPid.vid);
+    printf("pid=0x%.4X\n", info->vidPid.pid);
+    printf("manufacturerName=%s\n", info->manufacturerName);
+    printf("productName=%s\n", info->productName);
+    printf("serialNum=%s\n", info->serialNum);
+    printf("deviceFriendlyName=%s\n", info->deviceFriendlyName);
+
+    printf("numInterfaces=%d\n", info->numInterfaces);
+    for (int ifindex = 0; ifindex < info->numInterfaces; ifindex++) {
+        const char *dt = cyusb_type_s(info->deviceType[ifindex]);
+        const char *dc = cyusb_class_s(info->deviceClass[ifindex]);
+            
+        printf("  if[%d].deviceClass=%s\n", ifindex, dc);
+        printf("  if[%d].deviceType=%s\n", ifindex, dt);
+    }
+
+#ifdef WIN32
+    printf("deviceBlock=0x%X\n", info->deviceBlock);
+#endif
+}
+
+// -d <vid>:<pid>
+void
+parse_vidpid(const char *spec, struct cyusb_selector *sel) {
+    char *ep;
+
+    sel->vid = strtol(spec, &ep, 0);
+    sel->pid = strtol(ep + 1, NULL, 0);
+}
+
+void
+sleep_ms(int ms) {
+#ifdef WIN32
+    Sleep(ms);
+#else
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+// monotonic time in ns
+uint64_t
+now_ns(void) {
+#ifdef WIN32
+    LARGE_INTEGER freq, count;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart) * 1000000000 +
+           (uint64_t)(count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
@@ -0,0 +1,44 @@
+#ifndef CYUSB_CLI_H
+#define CYUSB_CLI_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "cyusb.h"
+
+#define DEFAULT_VID CYUSB_DEFAULT_VID
+#define DEFAULT_PID CYUSB_DEFAULT_PID
+
+#define log(...) do { fprintf(stderr, __VA_ARGS__); } while (0)
+#define die(...) do { log(__VA_ARGS__); exit(1); } while (0)
+
+#define DO(api, ...)                            \
+    do {                                        \
+        log(#api ": calling\n");                \
+        CY_RETURN_STATUS cs = api(__VA_ARGS__); \
+        if (cs != CY_SUCCESS) {                 \
+            die(#api ": cs=%d", cs);            \
+        }                                       \
+        log(#api ": OK\n");                     \
+    } while (0)
+    
+extern char *
+basename(char *p);
+
+extern void
+show_device(CY_DEVICE_INFO *info, void *data);
+
+extern void
+parse_vidpid(const char *spec, struct cyusb_selector *sel);
+
+extern void
+sleep_ms(int ms);
+
+extern uint64_t
+now_ns(void);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef CYUSB_CRC_H
+#define CYUSB_CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//
+// CRC32C (Castagnoli), as used in iSCSI/ext4. Start with crc = 0 and
+// feed data in chunks as it arrives:
+//
+//   crc = cyusb_crc32c(0, chunk1, len1);
+//   crc = cyusb_crc32c(crc, chunk2, len2);
+//
+// Uses the SSE4.2 crc32 instruction when the CPU has it.
+//
+extern uint32_t
+cyusb_crc32c(uint32_t crc, const void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * Run SPI/I2C command scripts on both serial blocks at once.
+ */
+
+#include "cyusb-dual.h"
+
+// keeps output lines of both threads from mixing
+static pthread_mutex_t print_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define show(bc, ...)                           \
+    do {                                        \
+        pthread_mutex_lock(&print_lock);        \
+        printf("scb%d: ", (bc)->block);         \
+        printf(__VA_ARGS__);                    \
+        fflush(stdout);                         \
+        pthread_mutex_unlock(&print_lock);      \
+    } while (0)
+
+#define warn(bc, ...)                                           \
+    do {                                                        \
+        pthread_mutex_lock(&print_lock);                        \
+        log("scb%d:%d: ", (bc)->block, (bc)->lineno);           \
+        log(__VA_ARGS__);                                       \
+        pthread_mutex_unlock(&print_lock);                      \
+    } while (0)
+
+void
+usage(char *prog) {
+    char *p = basename(prog);
+        
+    fprintf(stderr,
+            "Usage: %s [options] -0 <script> -1 <script>\n", p);
+    fprintf(stderr,
+            "Options:\n"
+            "  -h            : show this help\n"
+            "  -v            : verbose output\n"
+            "  -d <vid>:<pid>: select USB target by vendor and product ID\n"
+            "  -i <n>        : select <n>th one if -d option is ambigious\n"
+            "                  (on Windows, each serial block counts as one)\n"
+            "  -0 <script>   : run <script> on SCB0 (- for stdin)\n"
+            "  -1 <script>   : run <script> on SCB1 (- for stdin)\n"
+            "\n"
+            "Both scripts run at the same time, each on its own thread.\n"
+            "At most one of them can be read from stdin.\n"
+            "Script commands, one per line (# starts a comment):\n"
+            "  spi [<config>]            : configure as SPI (see cyusb-spi -h)\n"
+            "  i2c [<config> [<data>]]   : configure as I2C (see cyusb-i2c -h)\n"
+            "  rw <byte>...              : SPI write bytes, show bytes read\n"
+            "  w <byte>...               : I2C write bytes\n"
+            "  r <n>                     : I2C read <n> bytes\n"
+            "  sleep <ms>                : wait\n");
+    fprintf(stderr,
+            "Example:\n"
+            "  $ %s -0 flash.txt -1 pmic.txt\n", p);
+    exit(1);
+}
+
+//
+// Split line into words in place, dropping comments.
+//
+int
+split_line(char *line, char **argv) {
+    static const char *space = " \t\r\n";
+    int argc = 0;
+
+    line[strcspn(line, "#")] = '\0';
+
+    for (char *p = line + strspn(line, space); *p && argc < MAX_ARGS;) {
+        argv[argc++] = p;
+        p += strcspn(p, space);
+        if (*p) {
+            *p++ = '\0';
+            p += strspn(p, space);
+        }
+    }
+    return argc;
+}
+
+int
+parse_bytes(struct block_ctx *bc, int argc, char **argv) {
+    for (int i = 0; i < argc; i++) {
+        bc->tx[i] = strtol(argv[i], NULL, 0);
+    }
+    return argc;
+}
+
+void
+show_bytes(struct block_ctx *bc, const char *what, uint8_t *buf, int len) {
+    char line[MAX_ARGS * 5 + 1];
+    int pos = 0;
+
+    for (int i = 0; i < len; i++) {
+        pos += sprintf(line + pos, " 0x%.2X", buf[i]);
+    }
+    line[pos] = '\0';
+    show(bc, "%s:%s\n", what, line);
+}
+
+CY_RETURN_STATUS
+run_cmd(struct block_ctx *bc, int argc, char **argv) {
+    CY_RETURN_STATUS rc = CY_SUCCESS;
+    char *cmd = argv[0];
+
+    argc--;
+    argv++;
+
+    // Usage: spi 1000000:8:M:111000
+    if (strcmp(cmd, "spi") == 0) {
+        if (cyusb_parse_spi_config(argc > 0 ? argv[0] : DEFAULT_SPI_CONFIG,
+                                   &bc->spi_config) != 0) {
+            warn(bc, "Bad SPI config\n");
+            return CY_ERROR_INVALID_PARAMETER;
+        }
+        rc = cyusb_spi_configure(&bc->dev, &bc->spi_config);
+        bc->type = CY_TYPE_SPI;
+    }
+    // Usage: i2c 100000:0x10:10 0x50:10
+    else if (strcmp(cmd, "i2c") == 0) {
+        cyusb_parse_i2c_config(argc > 0 ? argv[0] : DEFAULT_I2C_CONFIG,
+                               &bc->i2c_config);
+        cyusb_parse_i2c_data_config(argc > 1 ? argv[1] : DEFAULT_I2C_DATA_CONFIG,
+                                    &bc->i2c_data_config);
+        rc = cyusb_i2c_configure(&bc->dev, &bc->i2c_config);
+        bc->type = CY_TYPE_I2C;
+    }
+    // Usage: rw 0x9F 0 0 0
+    else if (strcmp(cmd, "rw") == 0 && bc->type == CY_TYPE_SPI) {
+        struct cyusb_iov iov = {
+            .tx = bc->tx, .rx = bc->rx, .len = parse_bytes(bc, argc, argv),
+        };
+
+        rc = cyusb_spi_xfer(&bc->dev, &iov, 1, 1000);
+        if (rc == CY_SUCCESS) {
+            show_bytes(bc, "recv", bc->rx, iov.count);
+        }
+    }
+    // Usage: w 0x00 0x10
+    else if (strcmp(cmd, "w") == 0 && bc->type == CY_TYPE_I2C) {
+        struct cyusb_iov iov = {
+            .tx = bc->tx, .len = parse_bytes(bc, argc, argv),
+        };
+
+        rc = cyusb_i2c_xfer(&bc->dev, &bc->i2c_data_config, &iov, 1, 1000);
+        if (rc == CY_SUCCESS) {
+            show(bc, "sent: %d bytes\n", iov.count);
+        }
+    }
+    // Usage: r 4
+    else if (strcmp(cmd, "r") == 0 && bc->type == CY_TYPE_I2C && argc > 0) {
+        struct cyusb_iov iov = {
+            .rx = bc->rx, .len = atoi(argv[0]),
+        };
+
+        if (iov.len > sizeof(bc->rx)) {
+            iov.len = sizeof(bc->rx);
+        }
+        rc = cyusb_i2c_xfer(&bc->dev, &bc->i2c_data_config, &iov, 1, 1000);
+        if (rc == CY_SUCCESS) {
+            show_bytes(bc, "recv", bc->rx, iov.count);
+        }
+    }
+    // Usage: sleep 10
+    else if (strcmp(cmd, "sleep") == 0 && argc > 0) {
+        sleep_ms(atoi(argv[0]));
+    }
+    else {
+        warn(bc, "Unknown command, or not configured for it: %s\n", cmd);
+        return CY_ERROR_INVALID_PARAMETER;
+    }
+
+    if (rc != CY_SUCCESS) {
+        warn(bc, "%s: cs=%d\n", cmd, rc);
+    }
+    return rc;
+}
+
+void *
+run_block(void *data) {
+    struct block_ctx *bc = data;
+    char line[MAX_LINE];
+    char *argv[MAX_ARGS];
+
+    while (fgets(line, sizeof(line), bc->script)) {
+        bc->lineno++;
+
+        int argc = split_line(line, argv);
+        if (argc == 0) {
+            continue;
+        }
+
+        if (run_cmd(bc, argc, argv) != CY_SUCCESS) {
+            bc->failed = true;
+            break;
+        }
+    }
+    return NULL;
+}
+
+int
+parse_args(struct app_ctx *ctx, int argc, char **argv) {
+
+    if (argc <= 1) {
+        usage(argv[0]);
+    }
+
+    // defaults
+    cyusb_selector_init(&ctx->opt.sel);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "hvd:i:0:1:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage(argv[0]);
+            break;
+        case 'v':
+            ctx->opt.verbose = 1;
+            break;
+        case 'd':
+            parse_vidpid(optarg, &ctx->opt.sel);
+            break;
+        case 'i':
+            ctx->opt.sel.index = atoi(optarg);
+            break;
+        case '0':
+        case '1':
+            ctx->opt.script[opt - '0'] = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    if (!ctx->opt.script[0] && !ctx->opt.script[1]) {
+        usage(argv[0]);
+    }
+
+    // both threads reading one stdin would split lines between blocks
+    if (ctx->opt.script[0] && ctx->opt.script[1] &&
+        strcmp(ctx->opt.script[0], "-") == 0 && strcmp(ctx->opt.script[1], "-") == 0) {
+        die("Only one script can be read from stdin\n");
+    }
+
+    return optind;
+}
+
+void
+run(struct app_ctx *ctx) {
+    // threads start only after every block is open
+    for (int i = 0; i < NR_BLOCKS; i++) {
+        struct block_ctx *bc = &ctx->block[i];
+
+        if (!ctx->opt.script[i]) {
+            continue;
+        }
+
+        bc->block = i;
+        if (strcmp(ctx->opt.script[i], "-") == 0) {
+            bc->script = stdin;
+        }
+        else if (!(bc->script = fopen(ctx->opt.script[i], "r"))) {
+            die("Cannot open script: %s\n", ctx->opt.script[i]);
+        }
+
+        struct cyusb_selector sel = ctx->opt.sel;
+        sel.block = i;
+        DO(cyusb_open, &bc->dev, &sel);
+    }
+
+    for (int i = 0; i < NR_BLOCKS; i++) {
+        if (ctx->block[i].script &&
+            pthread_create(&ctx->block[i].thread, NULL, run_block, &ctx->block[i]) != 0) {
+            die("Cannot start thread for SCB%d\n", i);
+        }
+    }
+
+    for (int i = 0; i < NR_BLOCKS; i++) {
+        if (ctx->block[i].script) {
+            pthread_join(ctx->block[i].thread, NULL);
+        }
+    }
+
+    for (int i = 0; i < NR_BLOCKS; i++) {
+        if (ctx->block[i].script) {
+            DO(cyusb_close, &ctx->block[i].dev);
+            if (ctx->block[i].script != stdin) {
+                fclose(ctx->block[i].script);
+            }
+        }
+    }
+}
+
+int
+main(int argc, char **argv) {
+    static struct app_ctx ctx;
+
+    parse_args(&ctx, argc, argv);
+    run(&ctx);
+
+    for (int i = 0; i < NR_BLOCKS; i++) {
+        if (ctx.block[i].failed) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef CYUSB_DUAL_H
+#define CYUSB_DUAL_H
+
+#include <pthread.h>
+
+#include "cyusb-cli.h"
+
+#define NR_BLOCKS 2
+
+#define MAX_LINE  1024
+#define MAX_ARGS  256
+
+#define DEFAULT_SPI_CONFIG "100000:8:M:111000"
+#define DEFAULT_I2C_CONFIG "100000:0x10:10"
+#define DEFAULT_I2C_DATA_CONFIG "0x10:00"
+
+struct app_opt {
+    int verbose;
+    struct cyusb_selector sel;
+    char *script[NR_BLOCKS];
+};
+
+//
+// One serial block, driven by its own thread from its own script.
+//
+struct block_ctx {
+    int block;
+    struct cyusb_dev dev;
+
+    FILE *script;
+    int lineno;
+
+    CY_DEVICE_TYPE type;
+    CY_SPI_CONFIG spi_config;
+    CY_I2C_CONFIG i2c_config;
+    CY_I2C_DATA_CONFIG i2c_data_config;
+
+    // preallocated, so commands do no allocation
+    uint8_t tx[MAX_ARGS], rx[MAX_ARGS];
+
+    pthread_t thread;
+    bool failed;
+};
+
+struct app_ctx {
+    struct app_opt opt;
+
+    struct block_ctx block[NR_BLOCKS];
+};
+
+#endif
@@ -16,6 +16,9 @@ usage(char *prog) {
             "  -v            : verbose output\n"
             "  -d <vid>:<pid>: select USB target by vendor and product ID\n"
             "  -i <n>        : select <n>th one if -d option is ambigious\n"
+            "                  (on Windows, each serial block counts as one)\n"
+            "  -n <n>        : select serial block SCB<n> of dual-channel parts\n"
+            "  -I <n>        : select USB interface <n> (Linux only)\n"
             "  -f <config>   : set I2C configuration\n"
             "  -c <config>   : set data I2C configuration\n"
             "\n"
@@ -36,160 +39,6 @@ usage(char *prog) {
     exit(1);
 }
 
-// Under some configuration, mingw does not define strdup(3).
-char *
-my_strdup(const char *src) {
-    int len = strlen(src) + 1;
-    char *tmp = malloc(len);
-    return memcpy(tmp, src, len);
-}
-
-char *
-basename(char *p) {
-    char *pn = p;
-    char *ps;
-
-    ps = strrchr(p, '/');
-    if (pn < ps) pn = ps + 1;
-    ps = strrchr(p, '\\');
-    if (pn < ps) pn = ps + 1;
-    return pn;
-}
-
-const char *
-cydtype_s(CY_DEVICE_TYPE dt) {
-    switch (dt) {
-    case CY_TYPE_DISABLED: return "DISABLED";
-    case CY_TYPE_UART:     return "UART";
-    case CY_TYPE_SPI:      return "SPI";
-    case CY_TYPE_I2C:      return "I2C";
-    case CY_TYPE_JTAG:     return "JTAG";
-    case CY_TYPE_MFG:      return "MFG";
-    }
-    return "UNKNOWN";
-}
-
-const char *
-cydclass_s(CY_DEVICE_CLASS dc) {
-    switch (dc) {
-    case CY_CLASS_DISABLED: return "DISABLED";
-    case CY_CLASS_CDC:      return "CDC";
-    case CY_CLASS_PHDC:     return "PHDC";
-    case CY_CLASS_VENDOR:   return "VENDOR";
-    }
-    return "UNKNOWN";
-}
-
-void
-show_device(CY_DEVICE_INFO *info, void *data) {
-    printf("=====\n");
-    printf("vid=0x%.4X\n", info->vidPid.vid);
-    printf("pid=0x%.4X\n", info->vidPid.pid);
-    printf("manufacturerName=%s\n", info->manufacturerName);
-    printf("productName=%s\n", info->productName);
-    printf("serialNum=%s\n", info->serialNum);
-    printf("deviceFriendlyName=%s\n", info->deviceFriendlyName);
-
-    printf("numInterfaces=%d\n", info->numInterfaces);
-    for (int ifindex = 0; ifindex < info->numInterfaces; ifindex++) {
-        const char *dt = cydtype_s(info->deviceType[ifindex]);
-        const char *dc = cydclass_s(info->deviceClass[ifindex]);
-            
-        printf("  if[%d].deviceClass=%s\n", ifindex, dc);
-        printf("  if[%d].deviceType=%s\n", ifindex, dt);
-    }
-
-#ifdef WIN32
-    printf("deviceBlock=0x%X\n", info->deviceBlock);
-#endif
-}
-
-void
-pick_device(CY_DEVICE_INFO *info, void *data) {
-    struct app_ctx *ctx = data;
-
-    //show_device(info, data);
-
-    if (info->vidPid.vid != ctx->opt.vid || info->vidPid.pid != ctx->opt.pid) {
-        return;
-    }
-    ctx->nr_dev_found++;
-
-#ifdef WIN32
-    if (info->deviceBlock != SerialBlock_SCB0) {
-        return;
-    }
-#endif
-    ctx->nr_dev_match++;
-
-    if (ctx->nr_dev_match == ctx->opt.index + 1) {
-        ctx->selected.devnum = ctx->nr_dev_found - 1;
-#ifdef WIN32
-        ctx->selected.ifnum = 0; // On Windows, there is no interface to claim
-#else
-        ctx->selected.ifnum = 0;
-        for (int ifindex = 0; ifindex < info->numInterfaces; ifindex++) {
-            ctx->selected.ifnum = 0; // TODO: Which interface should be used?
-        }
-#endif
-    }
-}
-
-void
-scan_device(void (*scan)(CY_DEVICE_INFO *, void *), void *data) {
-    CY_RETURN_STATUS rc;
-    UINT8 nr;
-
-    rc = CyGetListofDevices(&nr);
-    if (rc != CY_SUCCESS) {
-        return;
-    }
-
-    for (int i = 0; i < nr; i++) {
-        CY_DEVICE_INFO info;
-
-        rc = CyGetDeviceInfo(i, &info);
-        if (rc == CY_SUCCESS) {
-            scan(&info, data);
-        }
-    }
-}
-
-int
-parse_i2c_config(const char *spec, CY_I2C_CONFIG *config) {
-    char *ep;
-
-    config->frequency = strtoul(spec, &ep, 10);
-
-    if (*ep++ != ':') {
-        return 0;
-    }
-
-    config->slaveAddress = strtoul(ep, &ep, 0);
-
-    if (*ep++ != ':') {
-        return 0;
-    }
-
-    config->isMaster       = (*ep++ == '1');
-    config->isClockStretch = (*ep++ == '1');
-
-    return 0;
-}
-
-int
-parse_i2c_data_config(const char *spec, CY_I2C_DATA_CONFIG *dc) {
-    char *ep;
-
-    dc->slaveAddress = strtoul(spec, &ep, 0);
-    ep++;
-
-    dc->isStopBit = (*ep++ == '1');
-    dc->isNakBit  = (*ep++ == '1');
-
-    return 0;
-}
-
 int
 parse_args(struct app_ctx *ctx, int argc, char **argv) {
 
@@ -198,14 +47,13 @@ parse_args(struct app_ctx *ctx, int argc, char **argv) {
     }
 
     // defaults
-    ctx->opt.vid = DEFAULT_VID;
-    ctx->opt.pid = DEFAULT_PID;
-    ctx->opt.index = 0;
+    cyusb_selector_init(&ctx->opt.sel);
+    ctx->opt.sel.type = CY_TYPE_I2C;
     ctx->opt.config = DEFAULT_CONFIG;
     ctx->opt.data_config = DEFAULT_DATA_CONFIG;
 
     int opt;
-    while ((opt = getopt(argc, argv, "hvd:i:f:c:")) != -1) {
+    while ((opt = getopt(argc, argv, "hvd:i:f:c:n:I:")) != -1) {
         switch (opt) {
         case 'h':
             usage(argv[0]);
@@ -213,31 +61,34 @@ parse_args(struct app_ctx *ctx, int argc, char **argv) {
         case 'v':
             ctx->opt.verbose = 1;
             break;
-        case 'd': {
-            char *ep;
-            ctx->opt.vid = strtol(optarg, &ep, 0);
-            ctx->opt.pid = strtol(ep + 1, NULL, 0);
+        case 'd':
+            parse_vidpid(optarg, &ctx->opt.sel);
             break;
-        }
         case 'i':
-            ctx->opt.index = atoi(optarg);
+            ctx->opt.sel.index = atoi(optarg);
+            break;
+        case 'n':
+            ctx->opt.sel.block = atoi(optarg);
+            break;
+        case 'I':
+            ctx->opt.sel.ifnum = atoi(optarg);
             break;
         case 'f':
-            ctx->opt.config = my_strdup(optarg);
+            ctx->opt.config = optarg;
             break;
         case 'c':
-            ctx->opt.data_config = my_strdup(optarg);
+            ctx->opt.data_config = optarg;
             break;
         default:
             usage(argv[0]);
         }
     }
 
-    if (parse_i2c_config(ctx->opt.config, &ctx->config) != 0) {
+    if (cyusb_parse_i2c_config(ctx->opt.config, &ctx->config) != 0) {
         usage(argv[0]);
     }
 
-    if (parse_i2c_data_config(ctx->opt.data_config, &ctx->data_config) != 0) {
+    if (cyusb_parse_i2c_data_config(ctx->opt.data_config, &ctx->data_config) != 0) {
         usage(argv[0]);
     }
 
@@ -246,40 +97,44 @@ parse_args(struct app_ctx *ctx, int argc, char **argv) {
 
 void
 run(struct app_ctx *ctx, int argc, char **argv) {
-    DO(CySetI2cConfig, ctx->handle, &ctx->config);
+    DO(cyusb_i2c_configure, &ctx->dev, &ctx->config);
 
     uint8_t buf[8];
 
-    CY_DATA_BUFFER db = {
-        .buffer = buf,
-        .length = sizeof(buf),
-        .transferCount = 0,
+    struct cyusb_iov iov = {
+        .len = sizeof(buf),
     };
 
     if (! argc) return;
 
     // Usage: cyusb-i2c r 2
     if (strcmp(argv[0], "r") == 0) {
-        db.length        = atoi(argv[1]);
-        db.transferCount = 0;
-        DO(CyI2cRead, ctx->handle, &ctx->data_config, &db, 1000);
+        iov.rx  = buf;
+        iov.len = argc > 1 ? atoi(argv[1]) : 0;
+        if (iov.len > sizeof(buf)) {
+            iov.len = sizeof(buf);
+        }
+        DO(cyusb_i2c_xfer, &ctx->dev, &ctx->data_config, &iov, 1, 1000);
 
         log("recv:");
-        for (int i = 0; i < db.transferCount; i++) {
-            log(" 0x%.2X", db.buffer[i]);
+        for (int i = 0; i < iov.count; i++) {
+            log(" 0x%.2X", buf[i]);
         }
         log("\n");
     }
     // Usage: cyusb-i2c w 0x12 0x23 0x34 ...
     else {
+        if (argc - 1 > sizeof(buf)) {
+            die("Too many bytes to write: %d (max %d)\n", argc - 1, (int)sizeof(buf));
+        }
         memset(buf, 0, sizeof(buf));
-        for (int i = 1; i < argc && i <= sizeof(buf); i++) {
+        for (int i = 1; i < argc; i++) {
             buf[i - 1] = strtol(argv[i], NULL, 0);
         }
-        db.length        = argc - 1;
-        db.transferCount = 0;
-        DO(CyI2cWrite, ctx->handle, &ctx->data_config, &db, 1000);
-        log("sent: %d bytes\n", db.transferCount);
+        iov.tx  = buf;
+        iov.len = argc - 1;
+        DO(cyusb_i2c_xfer, &ctx->dev, &ctx->data_config, &iov, 1, 1000);
+        log("sent: %d bytes\n", iov.count);
     }
 }
 
@@ -289,13 +144,9 @@ main(int argc, char **argv) {
 
     int optind = parse_args(&ctx, argc, argv);
 
-    ctx.selected.devnum = -1;
-    ctx.selected.ifnum  = -1;
-    scan_device(pick_device, &ctx);
-
-    DO(CyOpen, ctx.selected.devnum, ctx.selected.ifnum, &ctx.handle);
+    DO(cyusb_open, &ctx.dev, &ctx.opt.sel);
     run(&ctx, argc - optind, argv + optind);
-    DO(CyClose, ctx.handle);
+    DO(cyusb_close, &ctx.dev);
 
     return 0;
 }
@@ -0,0 +1,480 @@
+/*
+ * JTAG master test.
+ */
+
+#include "cyusb-jtag.h"
+
+void
+usage(char *prog) {
+    char *p = basename(prog);
+        
+    fprintf(stderr,
+            "Usage: %s [options] <cmd> <args...> [<cmd> <args...> ...]\n", p);
+    fprintf(stderr,
+            "Options:\n"
+            "  -h            : show this help\n"
+            "  -v            : verbose output\n"
+            "  -d <vid>:<pid>: select USB target by vendor and product ID\n"
+            "  -i <n>        : select <n>th one if -d option is ambigious\n"
+            "                  (on Windows, each serial block counts as one)\n"
+            "  -n <n>        : select serial block SCB<n> of dual-channel parts\n"
+            "  -I <n>        : select USB interface <n> (Linux only)\n"
+            "  -b <bytes>    : max bytes per USB transfer (default: %d)\n"
+            "  -o <file>     : save TDO of ir/dr shifts to <file> (LSbit-first)\n"
+            "\n"
+            "Commands (queued and sent together, TAP starts in Test-Logic-Reset):\n"
+            "  reset                  : go to Test-Logic-Reset, then Run-Test/Idle\n"
+            "  idle <n>               : run <n> clocks in Run-Test/Idle\n"
+            "  idcode                 : reset and list IDCODEs on the chain\n"
+            "  ir <bitlen> [<tdi>...] : shift IR, from Run-Test/Idle back to it\n"
+            "  dr <bitlen> [<tdi>...] : shift DR, from Run-Test/Idle back to it\n"
+            "\n"
+            "TDI values are shifted LSbit first. Each is one of 0b..., 0x..., or\n"
+            "a number, optionally followed by :<bitlen>, or @<file> to shift\n"
+            "bits from a binary file (LSbit-first). Missing bits are 0.\n",
+            DEFAULT_XFER_SIZE);
+    fprintf(stderr,
+            "Example:\n"
+            "  $ %s idcode\n", p);
+    fprintf(stderr,
+            "  $ %s ir 8 0x01 dr 32       # select IDCODE, read it back\n", p);
+    fprintf(stderr,
+            "  $ %s -o out.bin ir 8 0x00 dr 4096 @in.bin\n", p);
+    exit(1);
+}
+
+
+//
+// Make room for n more clocks in the queue.
+//
+void
+jtag_grow(struct jtag_queue *q, unsigned int n) {
+    if (q->nr_clk + n <= q->max_clk) {
+        return;
+    }
+
+    unsigned int max_clk = q->max_clk ? q->max_clk : 4096;
+    while (max_clk < q->nr_clk + n) {
+        max_clk <<= 1;
+    }
+
+    int old_len = q->max_clk >> 3;
+    int new_len = max_clk >> 3;
+
+    q->tms = realloc(q->tms, new_len);
+    q->tdi = realloc(q->tdi, new_len);
+    q->tdo = realloc(q->tdo, new_len);
+    if (!q->tms || !q->tdi || !q->tdo) {
+        die("Out of memory for %u clocks\n", max_clk);
+    }
+    memset(q->tms + old_len, 0, new_len - old_len);
+    memset(q->tdi + old_len, 0, new_len - old_len);
+    memset(q->tdo + old_len, 0, new_len - old_len);
+
+    q->max_clk = max_clk;
+}
+
+void
+jtag_clock(struct jtag_queue *q, bool tms, bool tdi) {
+    jtag_grow(q, 1);
+
+    if (tms) {
+        bit_set(q->tms, q->nr_clk);
+    }
+    else {
+        bit_clr(q->tms, q->nr_clk);
+    }
+
+    if (tdi) {
+        bit_set(q->tdi, q->nr_clk);
+    }
+    else {
+        bit_clr(q->tdi, q->nr_clk);
+    }
+
+    q->nr_clk++;
+}
+
+//
+// Any state -> Test-Logic-Reset -> Run-Test/Idle
+//
+void
+jtag_reset(struct jtag_queue *q) {
+    for (int i = 0; i < 5; i++) {
+        jtag_clock(q, 1, 0);
+    }
+    jtag_clock(q, 0, 0);
+}
+
+void
+jtag_idle(struct jtag_queue *q, unsigned int n) {
+    while (n--) {
+        jtag_clock(q, 0, 0);
+    }
+}
+
+//
+// Run-Test/Idle -> Shift-IR/DR -> (shift) -> Update-IR/DR -> Run-Test/Idle
+//
+// TDI comes from vec (LSbit-first, bitlen bits). TDO seen while
+// shifting is recorded as a capture to be reported on jtag_flush().
+//
+void
+jtag_shift(struct jtag_queue *q, bool is_ir, uint8_t *vec, unsigned int bitlen,
+           const char *name, bool is_idcode) {
+    if (bitlen == 0) {
+        return;
+    }
+
+    jtag_grow(q, bitlen + 6);
+
+    jtag_clock(q, 1, 0);             // Select-DR-Scan
+    if (is_ir) {
+        jtag_clock(q, 1, 0);         // Select-IR-Scan
+    }
+    jtag_clock(q, 0, 0);             // Capture-xR
+    jtag_clock(q, 0, 0);             // Shift-xR
+
+    if (q->nr_cap == q->max_cap) {
+        q->max_cap = q->max_cap ? q->max_cap << 1 : 16;
+        q->cap = realloc(q->cap, q->max_cap * sizeof(*q->cap));
+        if (!q->cap) {
+            die("Out of memory for %d captures\n", q->max_cap);
+        }
+    }
+    q->cap[q->nr_cap++] = (struct jtag_capture){
+        .name      = name,
+        .offset    = q->nr_clk,
+        .length    = bitlen,
+        .is_idcode = is_idcode,
+    };
+
+    for (unsigned int i = 0; i < bitlen; i++) {
+        jtag_clock(q, i == bitlen - 1, bit_get(vec, i)); // last one to Exit1
+    }
+
+    jtag_clock(q, 1, 0);             // Update-xR
+    jtag_clock(q, 0, 0);             // Run-Test/Idle
+}
+
+uint32_t
+tdo_word(struct jtag_queue *q, unsigned int pos, int len) {
+    uint32_t val = 0;
+
+    for (int i = 0; i < len; i++) {
+        if (bit_get(q->tdo, pos + i)) {
+            val |= (uint32_t)1 << i;
+        }
+    }
+    return val;
+}
+
+void
+report_idcode(struct jtag_queue *q, struct jtag_capture *cap) {
+    unsigned int pos = cap->offset;
+    unsigned int end = cap->offset + cap->length;
+    int nr = 0;
+
+    // Devices without IDCODE load 1-bit BYPASS (0) on reset.
+    // All 1s means we are seeing our own TDI fill come back.
+    while (pos < end) {
+        if (!bit_get(q->tdo, pos)) {
+            printf("dev[%d]: BYPASS (no IDCODE)\n", nr++);
+            pos++;
+            continue;
+        }
+
+        if (pos + 32 > end) {
+            break;
+        }
+
+        uint32_t id = tdo_word(q, pos, 32);
+        if (id == 0xFFFFFFFF) {
+            break;
+        }
+
+        printf("dev[%d]: idcode=0x%.8X version=0x%X part=0x%.4X manufacturer=0x%.3X\n",
+               nr++, id, id >> 28, (id >> 12) & 0xFFFF, (id >> 1) & 0x7FF);
+        pos += 32;
+    }
+    printf("devices=%d\n", nr);
+}
+
+void
+report_shift(struct app_ctx *ctx, struct jtag_capture *cap) {
+    struct jtag_queue *q = &ctx->queue;
+
+    // MSbit-first hex, as the value would be written on the command line
+    printf("%s[%u]: 0x", cap->name, cap->length);
+    for (int i = ((cap->length + 3) >> 2) - 1; i >= 0; i--) {
+        int len = cap->length - (i << 2);
+        printf("%X", tdo_word(q, cap->offset + (i << 2), len < 4 ? len : 4));
+    }
+    printf("\n");
+
+    if (ctx->output) {
+        for (unsigned int i = 0; i < cap->length; i += 8) {
+            int len = cap->length - i;
+            fputc(tdo_word(q, cap->offset + i, len < 8 ? len : 8), ctx->output);
+        }
+    }
+}
+
+//
+// Send whole queue to the bridge, in as few transfers as possible.
+//
+// Stream format: every 8 TCK cycles are sent as a TMS byte followed
+// by a TDI byte, and come back as one TDO byte. The bridge shifts
+// each byte MSbit-first like SPI, so bytes are bit reversed here
+// to keep the queue in LSbit-first (first clock = bit 0) order.
+//
+void
+jtag_flush(struct app_ctx *ctx) {
+    struct jtag_queue *q = &ctx->queue;
+
+    // We always end up in Run-Test/Idle, so padding there is harmless
+    while (q->nr_clk & 7) {
+        jtag_clock(q, 0, 0);
+    }
+
+    int nr_bytes = q->nr_clk >> 3;
+    int max_bytes = ctx->opt.xfer_size >> 1;
+
+    for (int off = 0; off < nr_bytes; off += max_bytes) {
+        int len = nr_bytes - off < max_bytes ? nr_bytes - off : max_bytes;
+
+        for (int i = 0; i < len; i++) {
+            ctx->xfer[(i << 1) + 0] = bit_rev(q->tms[off + i]);
+            ctx->xfer[(i << 1) + 1] = bit_rev(q->tdi[off + i]);
+        }
+
+        struct cyusb_iov iov[] = {
+            { .tx = ctx->xfer,   .len = len << 1 },
+            { .rx = q->tdo + off, .len = len },
+        };
+
+        DO(cyusb_jtag_xfer, &ctx->dev, iov, 2, 1000);
+
+        if (iov[1].count != len) {
+            die("Short TDO read: %d of %d bytes\n", iov[1].count, len);
+        }
+
+        for (int i = 0; i < len; i++) {
+            q->tdo[off + i] = bit_rev(q->tdo[off + i]);
+        }
+    }
+
+    for (int i = 0; i < q->nr_cap; i++) {
+        if (q->cap[i].is_idcode) {
+            report_idcode(q, &q->cap[i]);
+        }
+        else {
+            report_shift(ctx, &q->cap[i]);
+        }
+    }
+
+    q->nr_clk = 0;
+    q->nr_cap = 0;
+}
+
+//
+// Read TDI values from argv[*pi...] into vec (LSbit-first). Values
+// are consumed until an argument that looks like a command.
+//
+void
+parse_tdi(int argc, char **argv, int *pi, uint8_t *vec, unsigned int bitlen) {
+    unsigned int bpos = 0;
+
+    for (; *pi < argc; (*pi)++) {
+        char *arg = argv[*pi];
+
+        if (arg[0] == '@') {
+            FILE *fp = fopen(arg + 1, "rb");
+            int c;
+
+            if (!fp) {
+                die("Cannot open TDI file: %s\n", arg + 1);
+            }
+            while (bpos < bitlen && (c = fgetc(fp)) != EOF) {
+                for (int i = 0; i < 8 && bpos < bitlen; i++, bpos++) {
+                    if (c & (1 << i)) {
+                        bit_set(vec, bpos);
+                    }
+                }
+            }
+            fclose(fp);
+            continue;
+        }
+
+        if (arg[0] < '0' || '9' < arg[0]) {
+            break;
+        }
+
+        int      blen = 0;
+        uint64_t bval;
+
+        // read bitvec value
+        if (strncmp(arg, "0b", 2) == 0) {
+            blen = strlen(arg + 2);
+            bval = strtoull(arg + 2, &arg, 2);
+        }
+        else if (strncmp(arg, "0x", 2) == 0) {
+            blen = strlen(arg + 2) << 2;
+            bval = strtoull(arg, &arg, 16);
+        }
+        else {
+            bval = strtoull(arg, &arg, 0);
+            blen = ((bval <=       0xFF) ?  8 :
+                    (bval <=     0xFFFF) ? 16 :
+                    (bval <= 0xFFFFFFFF) ? 32 : 64);
+        }
+
+        // if given, read trailing bitvec length
+        if (*arg == ':') {
+            blen = strtol(arg + 1, NULL, 0);
+        }
+
+        if (bpos + blen > bitlen) {
+            die("Bit length too short for given value(s): %u\n", bitlen);
+        }
+
+        // LSbit goes out first
+        for (int i = 0; i < blen; i++, bpos++) {
+            if (i < 64 && (bval >> i) & 1) {
+                bit_set(vec, bpos);
+            }
+        }
+    }
+}
+
+int
+parse_args(struct app_ctx *ctx, int argc, char **argv) {
+
+    if (argc <= 1) {
+        usage(argv[0]);
+    }
+
+    // defaults
+    cyusb_selector_init(&ctx->opt.sel);
+    ctx->opt.sel.type = CY_TYPE_JTAG;
+    ctx->opt.xfer_size = DEFAULT_XFER_SIZE;
+    ctx->opt.output = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "hvd:i:b:o:n:I:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage(argv[0]);
+            break;
+        case 'v':
+            ctx->opt.verbose = 1;
+            break;
+        case 'd':
+            parse_vidpid(optarg, &ctx->opt.sel);
+            break;
+        case 'i':
+            ctx->opt.sel.index = atoi(optarg);
+            break;
+        case 'n':
+            ctx->opt.sel.block = atoi(optarg);
+            break;
+        case 'I':
+            ctx->opt.sel.ifnum = atoi(optarg);
+            break;
+        case 'b':
+            ctx->opt.xfer_size = strtol(optarg, NULL, 0) & ~1;
+            break;
+        case 'o':
+            ctx->opt.output = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    if (ctx->opt.xfer_size < 2) {
+        usage(argv[0]);
+    }
+
+    return optind;
+}
+
+void
+run(struct app_ctx *ctx, int argc, char **argv) {
+    struct jtag_queue *q = &ctx->queue;
+
+    if (! argc) return;
+
+    ctx->xfer = malloc(ctx->opt.xfer_size);
+    if (!ctx->xfer) {
+        die("Out of memory for %d byte transfer\n", ctx->opt.xfer_size);
+    }
+
+    if (ctx->opt.output) {
+        ctx->output = fopen(ctx->opt.output, "wb");
+        if (!ctx->output) {
+            die("Cannot open output file: %s\n", ctx->opt.output);
+        }
+    }
+
+    // TAP state is unknown until reset
+    jtag_reset(q);
+
+    for (int i = 0; i < argc;) {
+        char *cmd = argv[i++];
+
+        // Usage: cyusb-jtag reset
+        if (strcmp(cmd, "reset") == 0) {
+            jtag_reset(q);
+        }
+        // Usage: cyusb-jtag idle 100
+        else if (strcmp(cmd, "idle") == 0 && i < argc) {
+            jtag_idle(q, strtoul(argv[i++], NULL, 0));
+        }
+        // Usage: cyusb-jtag idcode
+        else if (strcmp(cmd, "idcode") == 0) {
+            unsigned int bitlen = 32 * (MAX_CHAIN_DEVICES + 1);
+            uint8_t ones[bitlen >> 3];
+
+            memset(ones, 0xFF, sizeof(ones));
+            jtag_reset(q);
+            jtag_shift(q, false, ones, bitlen, cmd, true);
+        }
+        // Usage: cyusb-jtag ir 8 0x01 dr 32 0:32 ...
+        else if ((strcmp(cmd, "ir") == 0 || strcmp(cmd, "dr") == 0) && i < argc) {
+            unsigned int bitlen = strtoul(argv[i++], NULL, 0);
+            uint8_t *vec = calloc((bitlen >> 3) + 1, 1);
+
+            if (!vec) {
+                die("Out of memory for %u bits\n", bitlen);
+            }
+            parse_tdi(argc, argv, &i, vec, bitlen);
+            jtag_shift(q, cmd[0] == 'i', vec, bitlen, cmd, false);
+            free(vec);
+        }
+        else {
+            die("Unknown command or missing argument: %s\n", cmd);
+        }
+    }
+
+    DO(cyusb_jtag_enable, &ctx->dev);
+    jtag_flush(ctx);
+    DO(cyusb_jtag_disable, &ctx->dev);
+
+    if (ctx->output) {
+        fclose(ctx->output);
+    }
+}
+
+int
+main(int argc, char **argv) {
+    static struct app_ctx ctx;
+
+    int optind = parse_args(&ctx, argc, argv);
+
+    DO(cyusb_open, &ctx.dev, &ctx.opt.sel);
+    run(&ctx, argc - optind, argv + optind);
+    DO(cyusb_close, &ctx.dev);
+
+    return 0;
+}
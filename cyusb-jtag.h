@@ -0,0 +1,52 @@
+#ifndef CYUSB_JTAG_H
+#define CYUSB_JTAG_H
+
+#include "cyusb-cli.h"
+#include "cyusb-bitvec.h"
+
+// Largest single CyJtagWrite() in bytes. Each 8 TCK cycles take 2 bytes.
+#define DEFAULT_XFER_SIZE 4096
+
+// Longest chain `idcode` will look through.
+#define MAX_CHAIN_DEVICES 32
+
+struct app_opt {
+    int verbose;
+    struct cyusb_selector sel;
+    int xfer_size;
+    char *output;
+};
+
+//
+// A queued TDO capture. Offset and length are in TCK cycles
+// from the start of the queue.
+//
+struct jtag_capture {
+    const char *name;
+    unsigned int offset, length;
+    bool is_idcode;
+};
+
+//
+// TAP operations are queued as TMS/TDI bit vectors (LSbit-first,
+// one bit per TCK) and only sent to the bridge on jtag_flush(),
+// so a whole command line goes out in as few transfers as possible.
+//
+struct jtag_queue {
+    uint8_t *tms, *tdi, *tdo;
+    unsigned int nr_clk, max_clk;
+
+    struct jtag_capture *cap;
+    int nr_cap, max_cap;
+};
+
+struct app_ctx {
+    struct app_opt opt;
+
+    struct cyusb_dev dev;
+    struct jtag_queue queue;
+    uint8_t *xfer;
+    FILE *output;
+};
+
+#endif
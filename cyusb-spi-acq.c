@@ -0,0 +1,373 @@
+/*
+ * Fixed-rate SPI acquisition for `cyusb-spi acquire`.
+ *
+ * Acquisition thread issues one CySpiReadWrite() per frame on a
+ * fixed 1/<rate> time grid, receiving straight into a preallocated
+ * ring. Each ring slot holds <batch> frames, and writer thread
+ * drains filled slots into the output file, so file I/O never delays
+ * the next frame.
+ *
+ * Frame <n> always lands at offset <n> * <frame length> of the output.
+ * Frames missed (too late for the grid) or dropped (ring full) are
+ * left zero-filled, so the file keeps the time base of the grid.
+ */
+
+#ifndef WIN32
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include <pthread.h>
+#include <math.h>
+
+#include "cyusb-spi.h"
+
+#ifdef WIN32
+#include <mmsystem.h>
+#endif
+
+struct acq_ring {
+    uint8_t *buf;
+    uint32_t slot_len;
+    unsigned long first[ACQ_RING_SLOTS];    // first frame in each slot
+    uint32_t len[ACQ_RING_SLOTS];           // bytes filled in each slot
+
+    // free running counters, slot is counter % ACQ_RING_SLOTS
+    unsigned long head, tail;
+    bool done;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+struct acq_ctx {
+    struct app_ctx *app;
+
+    uint64_t period;            // ns per frame
+    unsigned long nr_frame;     // frames to run
+    uint32_t frame_len;         // bytes per frame
+    int batch;                  // frames per ring slot
+
+    uint8_t *tx, *scratch, *zero;
+    struct acq_ring ring;
+
+    FILE *fp;
+    uint8_t *map;
+    uint64_t map_len, written;
+
+    // filled in by acquisition thread
+    unsigned long nr_end;       // frames covered, less than nr_frame on error
+    unsigned long nr_done, nr_missed, nr_dropped;
+    uint64_t t_first, t_last;
+    double late_sum, late_sq, late_max;
+    bool failed;
+};
+
+static void
+wait_until(uint64_t deadline) {
+    uint64_t now;
+
+    // sleep while far away, spin for the last couple of ms, as a
+    // sleep may overrun by one timer tick (1 ms with timeBeginPeriod)
+    while ((now = now_ns()) < deadline) {
+        if (deadline - now > 3000000) {
+            sleep_ms((deadline - now) / 1000000 - 2);
+        }
+    }
+}
+
+static void
+publish_slot(struct acq_ring *r, unsigned long first, uint32_t len) {
+    pthread_mutex_lock(&r->lock);
+    r->first[r->head % ACQ_RING_SLOTS] = first;
+    r->len[r->head % ACQ_RING_SLOTS] = len;
+    r->head++;
+    pthread_cond_signal(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+}
+
+static void *
+acq_thread(void *data) {
+    struct acq_ctx *ac = data;
+    struct acq_ring *r = &ac->ring;
+    uint64_t t0 = now_ns();
+    bool full = false;
+    unsigned long i;
+
+    for (i = 0; i < ac->nr_frame; i++) {
+        uint64_t deadline = t0 + i * ac->period;
+        int pos = i % ac->batch;
+
+        // only look for a free slot when starting a new one
+        if (pos == 0) {
+            pthread_mutex_lock(&r->lock);
+            full = (r->head - r->tail == ACQ_RING_SLOTS);
+            pthread_mutex_unlock(&r->lock);
+        }
+
+        // writer only reads the slot after head moves past it
+        uint8_t *slot = r->buf + (r->head % ACQ_RING_SLOTS) * r->slot_len;
+        uint8_t *rx = full ? ac->scratch : slot + pos * ac->frame_len;
+
+        // a whole period late: give up this frame to stay on the grid
+        if (now_ns() > deadline + ac->period) {
+            memset(rx, 0, ac->frame_len);
+            ac->nr_missed++;
+        }
+        else {
+            wait_until(deadline);
+
+            uint64_t start = now_ns();
+            double late = start - deadline;
+
+            ac->late_sum += late;
+            ac->late_sq  += late * late;
+            if (late > ac->late_max) {
+                ac->late_max = late;
+            }
+            if (!ac->nr_done) {
+                ac->t_first = start;
+            }
+            ac->t_last = start;
+
+            struct cyusb_iov iov = { .tx = ac->tx, .rx = rx, .len = ac->frame_len };
+            CY_RETURN_STATUS cs = cyusb_spi_xfer(&ac->app->dev, &iov, 1, 1000);
+
+            if (cs != CY_SUCCESS || iov.count != iov.len) {
+                log("Frame %lu failed: cs=%d, %u of %u bytes\n",
+                    i, cs, iov.count, iov.len);
+                ac->failed = true;
+                break;
+            }
+            ac->nr_done++;
+
+            // whole slot is skipped, writer leaves a zero-filled hole
+            if (full) {
+                ac->nr_dropped++;
+            }
+        }
+
+        if (!full && pos == ac->batch - 1) {
+            publish_slot(r, i - pos, ac->batch * ac->frame_len);
+        }
+    }
+
+    // last slot may be partly filled
+    int pos = i % ac->batch;
+    if (!full && pos) {
+        publish_slot(r, i - pos, pos * ac->frame_len);
+    }
+
+    pthread_mutex_lock(&r->lock);
+    ac->nr_end = i;
+    r->done = true;
+    pthread_cond_signal(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+
+    return NULL;
+}
+
+//
+// Zero-fill plain output file up to <end>, for frames never received.
+//
+static void
+fill_until(struct acq_ctx *ac, uint64_t end) {
+    while (ac->written < end) {
+        uint64_t n = end - ac->written;
+        if (n > ac->ring.slot_len) {
+            n = ac->ring.slot_len;
+        }
+        if (fwrite(ac->zero, 1, n, ac->fp) != n) {
+            die("Failed to write output\n");
+        }
+        ac->written += n;
+    }
+}
+
+static void *
+writer_thread(void *data) {
+    struct acq_ctx *ac = data;
+    struct acq_ring *r = &ac->ring;
+
+    for (;;) {
+        pthread_mutex_lock(&r->lock);
+        while (r->head == r->tail && !r->done) {
+            pthread_cond_wait(&r->cond, &r->lock);
+        }
+        if (r->head == r->tail) {
+            pthread_mutex_unlock(&r->lock);
+            break;
+        }
+        uint8_t *slot = r->buf + (r->tail % ACQ_RING_SLOTS) * r->slot_len;
+        uint64_t off = (uint64_t)r->first[r->tail % ACQ_RING_SLOTS] * ac->frame_len;
+        uint32_t len = r->len[r->tail % ACQ_RING_SLOTS];
+        pthread_mutex_unlock(&r->lock);
+
+        // mapped file is already zero-filled at its full length
+        if (ac->map) {
+            memcpy(ac->map + off, slot, len);
+        }
+        else {
+            fill_until(ac, off);
+            if (fwrite(slot, 1, len, ac->fp) != len) {
+                die("Failed to write output\n");
+            }
+        }
+        ac->written = off + len;
+
+        pthread_mutex_lock(&r->lock);
+        r->tail++;
+        pthread_mutex_unlock(&r->lock);
+    }
+
+    // dropped slots at the very end
+    if (!ac->map) {
+        fill_until(ac, (uint64_t)ac->nr_end * ac->frame_len);
+    }
+    ac->written = (uint64_t)ac->nr_end * ac->frame_len;
+
+    return NULL;
+}
+
+#ifndef WIN32
+static int map_fd = -1;
+
+static void
+open_map(struct acq_ctx *ac, const char *path) {
+    map_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (map_fd < 0 || ftruncate(map_fd, ac->map_len) != 0) {
+        die("Cannot create output file: %s\n", path);
+    }
+
+    ac->map = mmap(NULL, ac->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, map_fd, 0);
+    if (ac->map == MAP_FAILED) {
+        die("Cannot map output file: %s\n", path);
+    }
+}
+
+static void
+close_map(struct acq_ctx *ac) {
+    munmap(ac->map, ac->map_len);
+
+    // drop the part after a failed frame, holes before it stay
+    if (ftruncate(map_fd, ac->written) != 0) {
+        log("Cannot trim output file\n");
+    }
+    close(map_fd);
+}
+#endif
+
+static void
+report(struct acq_ctx *ac, double rate) {
+    double elapsed = (ac->t_last - ac->t_first) / 1e9;
+    double mean = ac->nr_done ? ac->late_sum / ac->nr_done : 0;
+    double rms  = ac->nr_done ? sqrt(ac->late_sq / ac->nr_done) : 0;
+
+    printf("acquire: %lu frames in %.3f s, %lu written\n",
+           ac->nr_done, elapsed, ac->nr_end);
+    if (ac->nr_done > 1) {
+        printf("acquire: rate=%.1f frames/s (target %.1f)\n",
+               (ac->nr_done - 1) / elapsed, rate);
+    }
+    printf("acquire: jitter mean=%.1f us rms=%.1f us max=%.1f us\n",
+           mean / 1e3, rms / 1e3, ac->late_max / 1e3);
+    printf("acquire: missed=%lu dropped=%lu frames (zero-filled)\n",
+           ac->nr_missed, ac->nr_dropped);
+}
+
+//
+// Usage: acquire <rate>[:<batch>] <frames> <file> <byte>...
+//
+// Returns non-zero if acquisition stopped on an error.
+//
+int
+acquire(struct app_ctx *ctx, int argc, char **argv) {
+    static struct acq_ctx ac;
+    char *ep;
+
+    double rate  = strtod(argv[0], &ep);
+    int    batch = (*ep == ':') ? atoi(ep + 1) : 1;
+    unsigned long nr_frame = strtoul(argv[1], NULL, 0);
+    const char *path = argv[2];
+    int frame_len = argc - 3;
+
+    if (rate <= 0 || batch <= 0 || nr_frame == 0) {
+        die("Bad rate, batch or frame count\n");
+    }
+
+    ac.app       = ctx;
+    ac.period    = 1e9 / rate;
+    ac.nr_frame  = nr_frame;
+    ac.frame_len = frame_len;
+    ac.batch     = batch;
+    ac.map_len   = (uint64_t)nr_frame * frame_len;
+
+    // everything is allocated up front, nothing while running
+    ac.ring.slot_len = frame_len * batch;
+    ac.tx       = malloc(frame_len);
+    ac.scratch  = malloc(frame_len);
+    ac.zero     = calloc(1, ac.ring.slot_len);
+    ac.ring.buf = malloc((size_t)ACQ_RING_SLOTS * ac.ring.slot_len);
+    if (!ac.tx || !ac.scratch || !ac.zero || !ac.ring.buf) {
+        die("Out of memory for %d slots of %u bytes\n", ACQ_RING_SLOTS, ac.ring.slot_len);
+    }
+
+    // touch the ring now, so page faults do not land on the frame grid
+    memset(ac.ring.buf, 0, (size_t)ACQ_RING_SLOTS * ac.ring.slot_len);
+    pthread_mutex_init(&ac.ring.lock, NULL);
+    pthread_cond_init(&ac.ring.cond, NULL);
+
+    for (int i = 0; i < frame_len; i++) {
+        ac.tx[i] = strtol(argv[3 + i], NULL, 0);
+    }
+
+    if (ctx->opt.mmap) {
+#ifdef WIN32
+        log("No memory-mapped output on Windows, using plain file\n");
+#else
+        open_map(&ac, path);
+#endif
+    }
+    if (!ac.map) {
+        ac.fp = fopen(path, "wb");
+        if (!ac.fp) {
+            die("Cannot open file: %s\n", path);
+        }
+    }
+
+    pthread_t acq, writer;
+
+#ifdef WIN32
+    // default ~15.6ms timer tick is far too coarse for the frame grid
+    timeBeginPeriod(1);
+#endif
+    if (pthread_create(&writer, NULL, writer_thread, &ac) != 0 ||
+        pthread_create(&acq, NULL, acq_thread, &ac) != 0) {
+        die("Cannot start acquisition threads\n");
+    }
+    pthread_join(acq, NULL);
+    pthread_join(writer, NULL);
+#ifdef WIN32
+    timeEndPeriod(1);
+#endif
+
+#ifndef WIN32
+    if (ac.map) {
+        close_map(&ac);
+    }
+#endif
+    if (ac.fp) {
+        fclose(ac.fp);
+    }
+
+    report(&ac, rate);
+
+    free(ac.tx);
+    free(ac.scratch);
+    free(ac.zero);
+    free(ac.ring.buf);
+
+    return ac.failed;
+}
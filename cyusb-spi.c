@@ -16,7 +16,14 @@ usage(char *prog) {
             "  -v            : verbose output\n"
             "  -d <vid>:<pid>: select USB target by vendor and product ID\n"
             "  -i <n>        : select <n>th one if -d option is ambigious\n"
+            "                  (on Windows, each serial block counts as one)\n"
+            "  -n <n>        : select serial block SCB<n> of dual-channel parts\n"
+            "  -I <n>        : select USB interface <n> (Linux only)\n"
             "  -c <config>   : set SPI configuration (below)\n"
+            "  -s <bytes>    : flash sector size for read/hash/verify (default: %d)\n"
+            "  -R <n>        : retry a failed flash read <n> times (default: %d)\n"
+            "  -r, --resume  : continue read/hash from its journal\n"
+            "  -m            : acquire into a memory-mapped output file\n"
             "\n"
             "Default SPI config: -c " DEFAULT_CONFIG "\n"
             "                       ^^^^^^frequency-in-HZ\n"
@@ -27,170 +34,33 @@ usage(char *prog) {
             "                                    ^isContinuous\n"
             "                                     ^isSelectPrecede\n"
             "                                      ^isCpha\n"
-            "                                       ^isCpol\n");
+            "                                       ^isCpol\n",
+            DEFAULT_SECTOR_SIZE, DEFAULT_RETRIES);
     fprintf(stderr,
             "Example:\n"
             "  $ %s rw 7        # run 7 clocks, writing 0000000\n", p);
     fprintf(stderr,
             "  $ %s rw 7 0b1011 # run 7 clocks, writing 1011000\n", p);
+    fprintf(stderr,
+            "  $ %s read 0 0x100000 dump.bin [manifest.txt]\n"
+            "                   # read 1MB of flash (and its CRC32C manifest)\n"
+            "                   # progress is kept in the manifest, or in\n"
+            "                   # dump.bin.journal if no manifest is given\n", p);
+    fprintf(stderr,
+            "  $ %s hash 0 0x100000 manifest.txt\n"
+            "                   # only write CRC32C of each sector to manifest\n", p);
+    fprintf(stderr,
+            "  $ %s verify manifest.txt\n"
+            "                   # compare flash with manifest, per sector\n", p);
+    fprintf(stderr,
+            "  $ %s acquire 1000:10 10000 out.bin 0x06 0x00 0x00\n"
+            "                   # send 3-byte frame 1000 times/s, one transfer each,\n"
+            "                   # buffer 10 frames per write, save 10000 frames to out.bin\n"
+            "                   # frame n is at offset n * 3; missed or dropped\n"
+            "                   # frames are left zero-filled\n", p);
     exit(1);
 }
 
-// Under some configuration, mingw does not define strdup(3).
-char *
-my_strdup(const char *src) {
-    int len = strlen(src) + 1;
-    char *tmp = malloc(len);
-    return memcpy(tmp, src, len);
-}
-
-char *
-basename(char *p) {
-    char *pn = p;
-    char *ps;
-
-    ps = strrchr(p, '/');
-    if (pn < ps) pn = ps + 1;
-    ps = strrchr(p, '\\');
-    if (pn < ps) pn = ps + 1;
-    return pn;
-}
-
-const char *
-cydtype_s(CY_DEVICE_TYPE dt) {
-    switch (dt) {
-    case CY_TYPE_DISABLED: return "DISABLED";
-    case CY_TYPE_UART:     return "UART";
-    case CY_TYPE_SPI:      return "SPI";
-    case CY_TYPE_I2C:      return "I2C";
-    case CY_TYPE_JTAG:     return "JTAG";
-    case CY_TYPE_MFG:      return "MFG";
-    }
-    return "UNKNOWN";
-}
-
-const char *
-cydclass_s(CY_DEVICE_CLASS dc) {
-    switch (dc) {
-    case CY_CLASS_DISABLED: return "DISABLED";
-    case CY_CLASS_CDC:      return "CDC";
-    case CY_CLASS_PHDC:     return "PHDC";
-    case CY_CLASS_VENDOR:   return "VENDOR";
-    }
-    return "UNKNOWN";
-}
-
-void
-show_device(CY_DEVICE_INFO *info, void *data) {
-    printf("=====\n");
-    printf("vid=0x%.4X\n", info->vidPid.vid);
-    printf("pid=0x%.4X\n", info->vidPid.pid);
-    printf("manufacturerName=%s\n", info->manufacturerName);
-    printf("productName=%s\n", info->productName);
-    printf("serialNum=%s\n", info->serialNum);
-    printf("deviceFriendlyName=%s\n", info->deviceFriendlyName);
-
-    printf("numInterfaces=%d\n", info->numInterfaces);
-    for (int ifindex = 0; ifindex < info->numInterfaces; ifindex++) {
-        const char *dt = cydtype_s(info->deviceType[ifindex]);
-        const char *dc = cydclass_s(info->deviceClass[ifindex]);
-            
-        printf("  if[%d].deviceClass=%s\n", ifindex, dc);
-        printf("  if[%d].deviceType=%s\n", ifindex, dt);
-    }
-
-#ifdef WIN32
-    printf("deviceBlock=0x%X\n", info->deviceBlock);
-#endif
-}
-
-void
-pick_device(CY_DEVICE_INFO *info, void *data) {
-    struct app_ctx *ctx = data;
-
-    //show_device(info, data);
-
-    if (info->vidPid.vid != ctx->opt.vid || info->vidPid.pid != ctx->opt.pid) {
-        return;
-    }
-    ctx->nr_dev_found++;
-
-#ifdef WIN32
-    if (info->deviceBlock != SerialBlock_SCB0) {
-        return;
-    }
-#endif
-    ctx->nr_dev_match++;
-
-    if (ctx->nr_dev_match == ctx->opt.index + 1) {
-        ctx->selected.devnum = ctx->nr_dev_found - 1;
-#ifdef WIN32
-        ctx->selected.ifnum = 0; // On Windows, there is no interface to claim
-#else
-        ctx->selected.ifnum = 0;
-        for (int ifindex = 0; ifindex < info->numInterfaces; ifindex++) {
-            ctx->selected.ifnum = 0; // TODO: Which interface should I use?
-        }
-#endif
-    }
-}
-
-void
-scan_device(void (*scan)(CY_DEVICE_INFO *, void *), void *data) {
-    CY_RETURN_STATUS rc;
-    UINT8 nr;
-
-    rc = CyGetListofDevices(&nr);
-    if (rc != CY_SUCCESS) {
-        return;
-    }
-
-    for (int i = 0; i < nr; i++) {
-        CY_DEVICE_INFO info;
-
-        rc = CyGetDeviceInfo(i, &info);
-        if (rc == CY_SUCCESS) {
-            scan(&info, data);
-        }
-    }
-}
-
-int
-parse_spi_config(const char *spec, CY_SPI_CONFIG *cfg) {
-    CY_SPI_CONFIG tmp;
-    char c, *ep;
-
-    tmp.frequency = strtoul(spec, &ep, 10);
-    ep++;
-
-    tmp.dataWidth = strtoul(ep, &ep, 10);
-    ep++;
-
-    switch (c = *ep++) {
-    case 'M': tmp.protocol = CY_SPI_MOTOROLA; break;
-    case 'T': tmp.protocol = CY_SPI_TI; break;
-    case 'N': tmp.protocol = CY_SPI_NS; break;
-    default:
-        log("Unknown SPI protocol. Must be M/T/N: %c\n", c);
-        return -1;
-    }
-    ep++;
-
-    tmp.isMsbFirst       = (*ep++ == '1');
-    tmp.isMaster         = (*ep++ == '1');
-    tmp.isContinuousMode = (*ep++ == '1');
-    tmp.isSelectPrecede  = (*ep++ == '1');
-    tmp.isCpha           = (*ep++ == '1');
-    tmp.isCpol           = (*ep++ == '1');
-
-    if (*ep != '\0')
-        return -1;
-
-    *cfg = tmp;
-
-    return 0;
-}
-
 int
 parse_args(struct app_ctx *ctx, int argc, char **argv) {
 
@@ -199,13 +69,19 @@ parse_args(struct app_ctx *ctx, int argc, char **argv) {
     }
 
     // defaults
-    ctx->opt.vid = DEFAULT_VID;
-    ctx->opt.pid = DEFAULT_PID;
-    ctx->opt.index = 0;
+    cyusb_selector_init(&ctx->opt.sel);
+    ctx->opt.sel.type = CY_TYPE_SPI;
     ctx->opt.config = DEFAULT_CONFIG;
+    ctx->opt.sector = DEFAULT_SECTOR_SIZE;
+    ctx->opt.retries = DEFAULT_RETRIES;
+
+    static struct option long_opts[] = {
+        { "resume", no_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 },
+    };
 
     int opt;
-    while ((opt = getopt(argc, argv, "hvd:i:c:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "hvd:i:c:s:n:I:R:rm", long_opts, NULL)) != -1) {
         switch (opt) {
         case 'h':
             usage(argv[0]);
@@ -213,24 +89,43 @@ parse_args(struct app_ctx *ctx, int argc, char **argv) {
         case 'v':
             ctx->opt.verbose = 1;
             break;
-        case 'd': {
-            char *ep;
-            ctx->opt.vid = strtol(optarg, &ep, 0);
-            ctx->opt.pid = strtol(ep + 1, NULL, 0);
+        case 'd':
+            parse_vidpid(optarg, &ctx->opt.sel);
             break;
-        }
         case 'i':
-            ctx->opt.index = atoi(optarg);
+            ctx->opt.sel.index = atoi(optarg);
+            break;
+        case 'n':
+            ctx->opt.sel.block = atoi(optarg);
+            break;
+        case 'I':
+            ctx->opt.sel.ifnum = atoi(optarg);
             break;
         case 'c':
-            ctx->opt.config = my_strdup(optarg);
+            ctx->opt.config = optarg;
+            break;
+        case 's':
+            ctx->opt.sector = strtol(optarg, NULL, 0);
+            break;
+        case 'R':
+            ctx->opt.retries = atoi(optarg);
+            break;
+        case 'r':
+            ctx->opt.resume = true;
+            break;
+        case 'm':
+            ctx->opt.mmap = true;
             break;
         default:
             usage(argv[0]);
         }
     }
 
-    if (parse_spi_config(ctx->opt.config, &ctx->config) != 0) {
+    if (cyusb_parse_spi_config(ctx->opt.config, &ctx->config) != 0) {
+        usage(argv[0]);
+    }
+
+    if (ctx->opt.sector <= 0) {
         usage(argv[0]);
     }
 
@@ -238,23 +133,13 @@ parse_args(struct app_ctx *ctx, int argc, char **argv) {
 }
 
 void
-run(struct app_ctx *ctx, int argc, char **argv) {
-    if (argc < 2) {
-        return;
-    }
-
-    // Usage: cyusb-spi rw 123 0x12 0b10111 ...
-    if (strcmp(argv[0], "rw") != 0) {
-        return;
-    }
-
+cmd_rw(struct app_ctx *ctx, int argc, char **argv) {
     int bitlen = atoi(argv[1]);
     int buflen = (bitlen >> 3) + !!(bitlen >> 3);
 
     uint8_t rbuf[buflen], wbuf[buflen];
 
-    CY_DATA_BUFFER rb = { .buffer = rbuf, .length = buflen };
-    CY_DATA_BUFFER wb = { .buffer = wbuf, .length = buflen };
+    struct cyusb_iov iov = { .tx = wbuf, .rx = rbuf, .len = buflen };
 
     memset(wbuf, 0, buflen);
 
@@ -311,28 +196,382 @@ run(struct app_ctx *ctx, int argc, char **argv) {
     }
     log("\n");
 
-    DO(CySetSpiConfig, ctx->handle, &ctx->config);
-    DO(CySpiReadWrite, ctx->handle, &rb, &wb, 1000);
+    DO(cyusb_spi_xfer, &ctx->dev, &iov, 1, 1000);
     log("recv:");
-    for (int i = 0; i < rb.transferCount; i++) {
-        log(" 0x%.2X", rb.buffer[i]);
+    for (int i = 0; i < iov.count; i++) {
+        log(" 0x%.2X", rbuf[i]);
     }
     log("\n");
 }
 
+FILE *
+open_file(const char *path, const char *mode) {
+    FILE *fp = fopen(path, mode);
+    if (!fp) {
+        die("Cannot open file: %s\n", path);
+    }
+    return fp;
+}
+
+void
+alloc_sector(struct app_ctx *ctx, int sector) {
+    free(ctx->tx);
+    free(ctx->rx);
+
+    ctx->opt.sector = sector;
+    ctx->tx = calloc(sector + 4, 1);
+    ctx->rx = calloc(sector + 4, 1);
+    if (!ctx->tx || !ctx->rx) {
+        die("Out of memory for %d byte sector\n", sector);
+    }
+}
+
+//
+// Drop the handle and open the device again, so a replugged
+// bridge is picked up. Failure is left to the next transfer.
+//
+void
+reopen_device(struct app_ctx *ctx) {
+    cyusb_close(&ctx->dev);
+
+    if (cyusb_open(&ctx->dev, &ctx->opt.sel) != CY_SUCCESS) {
+        log("Reopen failed\n");
+        return;
+    }
+    if (cyusb_spi_configure(&ctx->dev, &ctx->config) != CY_SUCCESS) {
+        log("Reconfigure failed\n");
+        return;
+    }
+    log("Reopened device\n");
+}
+
+//
+// Read len (up to one sector) bytes at addr in one transaction,
+// retrying with backoff. Returns pointer to the data in ctx->rx.
+//
+uint8_t *
+flash_read(struct app_ctx *ctx, uint32_t addr, uint32_t len) {
+    struct cyusb_iov iov = { .tx = ctx->tx, .rx = ctx->rx, .len = len + 4 };
+    int backoff = RETRY_BACKOFF_MS;
+
+    // give slow clocks enough time for the whole transfer
+    uint32_t timeout = 1000;
+    if (ctx->config.frequency) {
+        timeout += (uint64_t)iov.len * 8 * 1000 / ctx->config.frequency;
+    }
+
+    ctx->tx[0] = FLASH_CMD_READ;
+    ctx->tx[1] = addr >> 16;
+    ctx->tx[2] = addr >> 8;
+    ctx->tx[3] = addr;
+
+    for (int retry = 0; ; retry++) {
+        CY_RETURN_STATUS cs = CY_ERROR_INVALID_HANDLE;
+
+        iov.count = 0;
+        if (ctx->dev.handle) {
+            cs = cyusb_spi_xfer(&ctx->dev, &iov, 1, timeout);
+        }
+        if (cs == CY_SUCCESS && iov.count == iov.len) {
+            return ctx->rx + 4;
+        }
+
+        log("Read at 0x%.6X failed: cs=%d, %u of %u bytes\n",
+            addr, cs, iov.count, iov.len);
+
+        if (retry == ctx->opt.retries) {
+            die("Giving up at 0x%.6X (read/hash can continue with --resume)\n", addr);
+        }
+
+        sleep_ms(backoff);
+        backoff = backoff * 2 > RETRY_BACKOFF_MAX_MS ? RETRY_BACKOFF_MAX_MS : backoff * 2;
+        reopen_device(ctx);
+    }
+}
+
+//
+// Flash range must be non-empty and fit in 3-byte addressing.
+//
+void
+check_range(uint32_t base, uint32_t len) {
+    if (len == 0 || base >= FLASH_MAX_SIZE || len > FLASH_MAX_SIZE - base) {
+        die("Flash range 0x%X+0x%X is empty or above 16MB\n", base, len);
+    }
+}
+
+uint32_t
+chunk_len(struct app_ctx *ctx, uint32_t base, uint32_t len, uint32_t off) {
+    return base + len - off < ctx->opt.sector ? base + len - off : ctx->opt.sector;
+}
+
+//
+// Check the journal left by an earlier run of the same job. Chunks
+// are trusted up to the first one that is missing, or (if there is
+// an image) no longer matches the image file. Returns number of
+// chunks to skip, with their CRCs in crc[].
+//
+int
+load_journal(struct app_ctx *ctx, const char *path, uint32_t base, uint32_t len,
+             FILE *image, uint32_t *crc) {
+    FILE *fp = fopen(path, "r");
+    unsigned int j_base, j_len, j_sector;
+    unsigned int off, c;
+    int nr = 0;
+
+    if (!fp) {
+        log("No journal to resume from: %s\n", path);
+        return 0;
+    }
+
+    if (fscanf(fp, "crc32c %x %x %x", &j_base, &j_len, &j_sector) != 3 ||
+        j_base != base || j_len != len || j_sector != ctx->opt.sector) {
+        die("Journal is for another job: %s\n", path);
+    }
+
+    while (fscanf(fp, "%x %x", &off, &c) == 2) {
+        if (off != base + nr * ctx->opt.sector) {
+            break;
+        }
+
+        if (image) {
+            uint32_t n = chunk_len(ctx, base, len, off);
+
+            if (fread(ctx->rx, 1, n, image) != n || cyusb_crc32c(0, ctx->rx, n) != c) {
+                break;
+            }
+        }
+        crc[nr++] = c;
+    }
+
+    fclose(fp);
+    return nr;
+}
+
+int
+replace_file(const char *from, const char *to) {
+#ifdef WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+    return rename(from, to);
+#endif
+}
+
+void
+write_journal_head(struct app_ctx *ctx, FILE *fp, uint32_t base, uint32_t len,
+                   uint32_t *crc, int nr) {
+    fprintf(fp, "crc32c 0x%.6X 0x%.6X 0x%X\n", base, len, ctx->opt.sector);
+    for (int i = 0; i < nr; i++) {
+        fprintf(fp, "0x%.6X 0x%.8X\n", base + i * ctx->opt.sector, crc[i]);
+    }
+    fflush(fp);
+}
+
+//
+// Manifest is a text file with a header line, one line per sector,
+// and a trailer with the number of sectors. Same flash contents
+// always give the same manifest, so boards can also be compared by
+// diff(1)-ing their manifests.
+//
+//   crc32c <base> <length> <sector-size>
+//   <offset> <crc32c>
+//   ...
+//   total <nr-sectors>
+//
+// The manifest is written as each sector completes, and doubles as
+// the journal to resume from. Trailer is only written once the job
+// completes, so an unfinished journal is never taken as a manifest.
+// Without a manifest, a temporary <image>.journal is used instead.
+//
+void
+dump_flash(struct app_ctx *ctx, uint32_t base, uint32_t len,
+           const char *image_path, const char *manifest_path) {
+    check_range(base, len);
+
+    int nr_chunk = (len + ctx->opt.sector - 1) / ctx->opt.sector;
+    uint32_t *crc = calloc(nr_chunk + 1, sizeof(*crc));
+    char *journal_path;
+    FILE *image = NULL;
+    int done = 0;
+
+    if (!crc) {
+        die("Out of memory for %d chunks\n", nr_chunk);
+    }
+
+    if (manifest_path) {
+        journal_path = (char *)manifest_path;
+    }
+    else {
+        journal_path = malloc(strlen(image_path) + sizeof(".journal"));
+        if (!journal_path) {
+            die("Out of memory for journal path\n");
+        }
+        sprintf(journal_path, "%s.journal", image_path);
+    }
+
+    if (image_path) {
+        image = ctx->opt.resume ? fopen(image_path, "r+b") : NULL;
+        if (!image) {
+            image = open_file(image_path, "wb");
+        }
+    }
+
+    if (ctx->opt.resume) {
+        done = load_journal(ctx, journal_path, base, len, image, crc);
+        if (image && fseek(image, (long)done * ctx->opt.sector, SEEK_SET) != 0) {
+            die("Cannot seek in image: %s\n", image_path);
+        }
+        log("Resuming at 0x%.6X\n", base + done * ctx->opt.sector);
+    }
+
+    FILE *journal;
+
+    if (ctx->opt.resume) {
+        // keep the old journal until the trusted part is safely rewritten
+        char tmp_path[strlen(journal_path) + sizeof(".tmp")];
+
+        sprintf(tmp_path, "%s.tmp", journal_path);
+        journal = open_file(tmp_path, "w");
+        write_journal_head(ctx, journal, base, len, crc, done);
+        if (fclose(journal) != 0 || replace_file(tmp_path, journal_path) != 0) {
+            die("Cannot update journal: %s\n", journal_path);
+        }
+        journal = open_file(journal_path, "a");
+    }
+    else {
+        journal = open_file(journal_path, "w");
+        write_journal_head(ctx, journal, base, len, crc, 0);
+    }
+
+    for (int i = done; i < nr_chunk; i++) {
+        uint32_t off = base + i * ctx->opt.sector;
+        uint32_t n = chunk_len(ctx, base, len, off);
+
+        uint8_t *data = flash_read(ctx, off, n);
+
+        // data must be in the image before the journal says so
+        if (image && (fwrite(data, 1, n, image) != n || fflush(image) != 0)) {
+            die("Failed to write image at 0x%.6X\n", off);
+        }
+        fprintf(journal, "0x%.6X 0x%.8X\n", off, cyusb_crc32c(0, data, n));
+        fflush(journal);
+    }
+    fprintf(journal, "total 0x%X\n", nr_chunk);
+
+    if (image) {
+        fclose(image);
+    }
+    fclose(journal);
+
+    // job is complete, nothing to resume
+    if (!manifest_path) {
+        remove(journal_path);
+        free(journal_path);
+    }
+    free(crc);
+}
+
+// Returns number of sectors not matching the manifest
+int
+verify_flash(struct app_ctx *ctx, FILE *manifest) {
+    unsigned int base, len, sector;
+    unsigned int off, c, total;
+    int nr = 0, nr_bad = 0;
+
+    if (fscanf(manifest, "crc32c %x %x %x", &base, &len, &sector) != 3 || !sector) {
+        die("Not a manifest file\n");
+    }
+    check_range(base, len);
+
+    // manifest decides the sector size
+    alloc_sector(ctx, sector);
+
+    int nr_sector = (len + sector - 1) / sector;
+    uint32_t *crc = calloc(nr_sector, sizeof(*crc));
+    if (!crc) {
+        die("Out of memory for %d sectors\n", nr_sector);
+    }
+
+    // check the whole manifest before spending time on flash
+    while (nr < nr_sector && fscanf(manifest, "%x %x", &off, &c) == 2) {
+        if (off != base + nr * sector) {
+            die("Sector 0x%.6X is out of order in manifest\n", off);
+        }
+        crc[nr++] = c;
+    }
+    if (nr != nr_sector ||
+        fscanf(manifest, " total %x", &total) != 1 || total != nr_sector) {
+        die("Manifest is incomplete (unfinished read/hash? use --resume)\n");
+    }
+
+    for (int i = 0; i < nr_sector; i++) {
+        off = base + i * sector;
+
+        uint32_t n = chunk_len(ctx, base, len, off);
+        uint32_t got = cyusb_crc32c(0, flash_read(ctx, off, n), n);
+        if (got != crc[i]) {
+            printf("0x%.6X: crc32c=0x%.8X expected=0x%.8X\n", off, got, crc[i]);
+            nr_bad++;
+        }
+    }
+
+    printf("verify: %d of %d sectors differ\n", nr_bad, nr_sector);
+    free(crc);
+    return nr_bad;
+}
+
+void
+run(struct app_ctx *ctx, int argc, char **argv) {
+    if (argc < 2) {
+        return;
+    }
+
+    DO(cyusb_spi_configure, &ctx->dev, &ctx->config);
+
+    alloc_sector(ctx, ctx->opt.sector);
+
+    // Usage: cyusb-spi rw 123 0x12 0b10111 ...
+    if (strcmp(argv[0], "rw") == 0) {
+        cmd_rw(ctx, argc, argv);
+    }
+    // Usage: cyusb-spi read 0 0x100000 dump.bin [manifest.txt]
+    else if (strcmp(argv[0], "read") == 0 && argc >= 4) {
+        dump_flash(ctx, strtoul(argv[1], NULL, 0), strtoul(argv[2], NULL, 0),
+                   argv[3], argc >= 5 ? argv[4] : NULL);
+    }
+    // Usage: cyusb-spi hash 0 0x100000 manifest.txt
+    else if (strcmp(argv[0], "hash") == 0 && argc >= 4) {
+        dump_flash(ctx, strtoul(argv[1], NULL, 0), strtoul(argv[2], NULL, 0),
+                   NULL, argv[3]);
+    }
+    // Usage: cyusb-spi acquire 1000:10 10000 out.bin 0x06 0x00 0x00
+    else if (strcmp(argv[0], "acquire") == 0 && argc >= 5) {
+        if (acquire(ctx, argc - 1, argv + 1) != 0) {
+            DO(cyusb_close, &ctx->dev);
+            exit(1);
+        }
+    }
+    // Usage: cyusb-spi verify manifest.txt
+    else if (strcmp(argv[0], "verify") == 0) {
+        FILE *manifest = open_file(argv[1], "r");
+        int nr_bad = verify_flash(ctx, manifest);
+
+        fclose(manifest);
+        if (nr_bad) {
+            DO(cyusb_close, &ctx->dev);
+            exit(1);
+        }
+    }
+}
+
 int
 main(int argc, char **argv) {
     static struct app_ctx ctx;
 
     int optind = parse_args(&ctx, argc, argv);
 
-    ctx.selected.devnum = -1;
-    ctx.selected.ifnum  = -1;
-    scan_device(pick_device, &ctx);
-
-    DO(CyOpen, ctx.selected.devnum, ctx.selected.ifnum, &ctx.handle);
+    DO(cyusb_open, &ctx.dev, &ctx.opt.sel);
     run(&ctx, argc - optind, argv + optind);
-    DO(CyClose, ctx.handle);
+    DO(cyusb_close, &ctx.dev);
 
     return 0;
 }
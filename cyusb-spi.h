@@ -1,81 +1,50 @@
 #ifndef CYUSB_SPI_H
 #define CYUSB_SPI_H
 
-#include <stdio.h>
-#include <stdint.h>
-#include <stdbool.h>
-#include <string.h>
-#include <getopt.h>
-
-#ifdef WIN32
-#include <windows.h>
-#endif
-
-#include "CyUSBSerial.h"
-
-#define DEFAULT_VID 0x04B4
-#define DEFAULT_PID 0x0004
+#include "cyusb-cli.h"
+#include "cyusb-bitvec.h"
+#include "cyusb-crc.h"
 
 #define DEFAULT_CONFIG "100000:8:M:111000"
 
-#define log(...) do { fprintf(stderr, __VA_ARGS__); } while (0)
-#define die(...) do { log(__VA_ARGS__); exit(1); } while (0)
+// Flash is read and hashed in chunks of this size
+#define DEFAULT_SECTOR_SIZE 4096
 
-#define DO(api, ...)                            \
-    do {                                        \
-        log(#api ": calling\n");                \
-        CY_RETURN_STATUS cs = api(__VA_ARGS__); \
-        if (cs != CY_SUCCESS) {                 \
-            die(#api ": cs=%d", cs);            \
-        }                                       \
-        log(#api ": OK\n");                     \
-    } while (0)
-    
-static inline void
-bit_set(uint8_t *vec, unsigned int i) {
-    vec[i >> 3] |=  (1 << (i & 7));
-}
+#define FLASH_CMD_READ 0x03
 
-static inline void
-bit_clr(uint8_t *vec, unsigned int i) {
-    vec[i >> 3] &= ~(1 << (i & 7));
-}
+// READ takes a 3-byte address
+#define FLASH_MAX_SIZE 0x1000000
 
-static inline bool
-bit_get(uint8_t *vec, unsigned int i) {
-    return !!(vec[i >> 3] & (1 << (i & 7)));
-}
+// Failed chunk is retried with backoff doubling up to max
+#define DEFAULT_RETRIES      5
+#define RETRY_BACKOFF_MS     100
+#define RETRY_BACKOFF_MAX_MS 5000
 
-static inline uint8_t
-bit_rev(uint8_t b) {
-    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
-    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
-    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
-    return b;
-}
+// Transfers buffered between acquisition and writer threads
+#define ACQ_RING_SLOTS 256
 
 struct app_opt {
     int verbose;
-    int vid, pid;
-    int index;
+    struct cyusb_selector sel;
 
     char *config;
+    int sector;
+    int retries;
+    bool resume;
+    bool mmap;
 };
 
 struct app_ctx {
     struct app_opt opt;
 
-    int nr_dev_found, nr_dev_match;
-
-    struct {
-        int devnum, ifnum;
-    } selected;
-
-    CY_HANDLE handle;
+    struct cyusb_dev dev;
     CY_SPI_CONFIG config;
+
+    // command + address + one sector
+    uint8_t *tx, *rx;
 };
 
-extern char *
-basename(char *p);
+extern int
+acquire(struct app_ctx *ctx, int argc, char **argv);
 
 #endif
@@ -0,0 +1,379 @@
+/*
+ * Library interface to Cypress USB-Serial bridges.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyusb.h"
+
+const char *
+cyusb_type_s(CY_DEVICE_TYPE dt) {
+    switch (dt) {
+    case CY_TYPE_DISABLED: return "DISABLED";
+    case CY_TYPE_UART:     return "UART";
+    case CY_TYPE_SPI:      return "SPI";
+    case CY_TYPE_I2C:      return "I2C";
+    case CY_TYPE_JTAG:     return "JTAG";
+    case CY_TYPE_MFG:      return "MFG";
+    }
+    return "UNKNOWN";
+}
+
+const char *
+cyusb_class_s(CY_DEVICE_CLASS dc) {
+    switch (dc) {
+    case CY_CLASS_DISABLED: return "DISABLED";
+    case CY_CLASS_CDC:      return "CDC";
+    case CY_CLASS_PHDC:     return "PHDC";
+    case CY_CLASS_VENDOR:   return "VENDOR";
+    }
+    return "UNKNOWN";
+}
+
+void
+cyusb_scan(void (*scan)(CY_DEVICE_INFO *, void *), void *data) {
+    CY_RETURN_STATUS rc;
+    UINT8 nr;
+
+    rc = CyGetListofDevices(&nr);
+    if (rc != CY_SUCCESS) {
+        return;
+    }
+
+    for (int i = 0; i < nr; i++) {
+        CY_DEVICE_INFO info;
+
+        rc = CyGetDeviceInfo(i, &info);
+        if (rc == CY_SUCCESS) {
+            scan(&info, data);
+        }
+    }
+}
+
+void
+cyusb_selector_init(struct cyusb_selector *sel) {
+    sel->vid   = CYUSB_DEFAULT_VID;
+    sel->pid   = CYUSB_DEFAULT_PID;
+    sel->index = 0;
+    sel->block = -1;
+    sel->ifnum = -1;
+    sel->type  = CY_TYPE_DISABLED;
+}
+
+#ifndef WIN32
+static bool
+cyusb_is_block(CY_DEVICE_INFO *info, int ifindex) {
+    if (info->deviceType[ifindex] == CY_TYPE_MFG) {
+        return false;
+    }
+    switch (info->deviceClass[ifindex]) {
+    case CY_CLASS_VENDOR:
+    case CY_CLASS_CDC:
+    case CY_CLASS_PHDC:
+        return true;
+    default:
+        return false;
+    }
+}
+#endif
+
+//
+// Serial block behind interface ifindex, or -1 if it is not one.
+//
+static int
+cyusb_block(CY_DEVICE_INFO *info, int ifindex) {
+#ifdef WIN32
+    // On Windows, each serial block shows up as its own device
+    switch (info->deviceBlock) {
+    case SerialBlock_SCB0: return 0;
+    case SerialBlock_SCB1: return 1;
+    default:               return -1;
+    }
+#else
+    // On Linux, each serial block starts with one vendor, CDC
+    // communication or PHDC interface. CDC data interface of a UART
+    // and manufacturing interface are not blocks of their own.
+    int block = -1;
+
+    for (int i = 0; i <= ifindex; i++) {
+        if (cyusb_is_block(info, i)) {
+            block++;
+        }
+    }
+    return cyusb_is_block(info, ifindex) ? block : -1;
+#endif
+}
+
+//
+// Find devnum/ifnum to pass to CyOpen() for the given selector.
+//
+static CY_RETURN_STATUS
+cyusb_select(const struct cyusb_selector *sel, struct cyusb_dev *dev) {
+    CY_RETURN_STATUS rc;
+    UINT8 nr;
+
+    rc = CyGetListofDevices(&nr);
+    if (rc != CY_SUCCESS) {
+        return rc;
+    }
+
+    // first look for the wanted type, then for any
+    for (int by_type = (sel->type != CY_TYPE_DISABLED); by_type >= 0; by_type--) {
+        int nr_match = 0;
+
+        for (int i = 0; i < nr; i++) {
+            CY_DEVICE_INFO info;
+
+            rc = CyGetDeviceInfo(i, &info);
+            if (rc != CY_SUCCESS) {
+                continue;
+            }
+
+            if (info.vidPid.vid != sel->vid || info.vidPid.pid != sel->pid) {
+                continue;
+            }
+
+#ifdef WIN32
+            int nr_if = 1; // On Windows, there is no interface to claim
+#else
+            int nr_if = info.numInterfaces;
+#endif
+            for (int ifindex = 0; ifindex < nr_if; ifindex++) {
+                int block = cyusb_block(&info, ifindex);
+
+                if (block < 0) {
+                    continue;
+                }
+                if (sel->block >= 0 && sel->block != block) {
+                    continue;
+                }
+#ifndef WIN32
+                if (sel->ifnum >= 0 && sel->ifnum != ifindex) {
+                    continue;
+                }
+#endif
+                if (by_type && info.deviceType[ifindex] != sel->type) {
+                    continue;
+                }
+
+                // index counts devices, not their blocks
+                if (nr_match++ != sel->index) {
+                    break;
+                }
+
+                dev->devnum = i;
+                dev->ifnum  = ifindex;
+                dev->block  = block;
+                return CY_SUCCESS;
+            }
+        }
+    }
+
+    return CY_ERROR_DEVICE_NOT_FOUND;
+}
+
+CY_RETURN_STATUS
+cyusb_open(struct cyusb_dev *dev, const struct cyusb_selector *sel) {
+    CY_RETURN_STATUS rc;
+
+    rc = cyusb_select(sel, dev);
+    if (rc != CY_SUCCESS) {
+        return rc;
+    }
+
+    return CyOpen(dev->devnum, dev->ifnum, &dev->handle);
+}
+
+CY_RETURN_STATUS
+cyusb_close(struct cyusb_dev *dev) {
+    CY_HANDLE handle = dev->handle;
+
+    // never hand a closed handle to cyusbserial again
+    if (!handle) {
+        return CY_ERROR_INVALID_HANDLE;
+    }
+    dev->handle = NULL;
+
+    return CyClose(handle);
+}
+
+int
+cyusb_parse_spi_config(const char *spec, CY_SPI_CONFIG *cfg) {
+    CY_SPI_CONFIG tmp;
+    char c, *ep;
+
+    tmp.frequency = strtoul(spec, &ep, 10);
+    ep++;
+
+    tmp.dataWidth = strtoul(ep, &ep, 10);
+    ep++;
+
+    switch (c = *ep++) {
+    case 'M': tmp.protocol = CY_SPI_MOTOROLA; break;
+    case 'T': tmp.protocol = CY_SPI_TI; break;
+    case 'N': tmp.protocol = CY_SPI_NS; break;
+    default:
+        return -1;
+    }
+    ep++;
+
+    tmp.isMsbFirst       = (*ep++ == '1');
+    tmp.isMaster         = (*ep++ == '1');
+    tmp.isContinuousMode = (*ep++ == '1');
+    tmp.isSelectPrecede  = (*ep++ == '1');
+    tmp.isCpha           = (*ep++ == '1');
+    tmp.isCpol           = (*ep++ == '1');
+
+    if (*ep != '\0')
+        return -1;
+
+    *cfg = tmp;
+
+    return 0;
+}
+
+int
+cyusb_parse_i2c_config(const char *spec, CY_I2C_CONFIG *config) {
+    char *ep;
+
+    config->frequency = strtoul(spec, &ep, 10);
+
+    if (*ep++ != ':') {
+        return 0;
+    }
+
+    config->slaveAddress = strtoul(ep, &ep, 0);
+
+    if (*ep++ != ':') {
+        return 0;
+    }
+
+    config->isMaster       = (*ep++ == '1');
+    config->isClockStretch = (*ep++ == '1');
+
+    return 0;
+}
+
+int
+cyusb_parse_i2c_data_config(const char *spec, CY_I2C_DATA_CONFIG *dc) {
+    char *ep;
+
+    dc->slaveAddress = strtoul(spec, &ep, 0);
+    ep++;
+
+    dc->isStopBit = (*ep++ == '1');
+    dc->isNakBit  = (*ep++ == '1');
+
+    return 0;
+}
+
+CY_RETURN_STATUS
+cyusb_spi_configure(struct cyusb_dev *dev, CY_SPI_CONFIG *cfg) {
+    return CySetSpiConfig(dev->handle, cfg);
+}
+
+//
+// Each segment is one CySpiReadWrite(), i.e. one select assertion.
+//
+CY_RETURN_STATUS
+cyusb_spi_xfer(struct cyusb_dev *dev,
+               struct cyusb_iov *iov, int nr, uint32_t timeout) {
+    for (int i = 0; i < nr; i++) {
+        CY_DATA_BUFFER rb = { .buffer = iov[i].rx,            .length = iov[i].len };
+        CY_DATA_BUFFER wb = { .buffer = (UCHAR *)iov[i].tx,   .length = iov[i].len };
+
+        CY_RETURN_STATUS rc = CySpiReadWrite(dev->handle,
+                                             iov[i].rx ? &rb : NULL,
+                                             iov[i].tx ? &wb : NULL,
+                                             timeout);
+        iov[i].count = iov[i].rx ? rb.transferCount : wb.transferCount;
+        if (rc != CY_SUCCESS) {
+            return rc;
+        }
+    }
+    return CY_SUCCESS;
+}
+
+CY_RETURN_STATUS
+cyusb_i2c_configure(struct cyusb_dev *dev, CY_I2C_CONFIG *cfg) {
+    return CySetI2cConfig(dev->handle, cfg);
+}
+
+//
+// Segments with tx are written, others are read into rx. All segments
+// form one message: stop bit (if set in dc) is only sent after the last.
+//
+CY_RETURN_STATUS
+cyusb_i2c_xfer(struct cyusb_dev *dev, const CY_I2C_DATA_CONFIG *dc,
+               struct cyusb_iov *iov, int nr, uint32_t timeout) {
+    CY_I2C_DATA_CONFIG tmp = *dc;
+
+    for (int i = 0; i < nr; i++) {
+        CY_DATA_BUFFER db = {
+            .buffer = iov[i].tx ? (UCHAR *)iov[i].tx : iov[i].rx,
+            .length = iov[i].len,
+            .transferCount = 0,
+        };
+        CY_RETURN_STATUS rc;
+
+        tmp.isStopBit = (i == nr - 1) ? dc->isStopBit : false;
+
+        if (iov[i].tx) {
+            rc = CyI2cWrite(dev->handle, &tmp, &db, timeout);
+        }
+        else {
+            rc = CyI2cRead(dev->handle, &tmp, &db, timeout);
+        }
+        iov[i].count = db.transferCount;
+        if (rc != CY_SUCCESS) {
+            return rc;
+        }
+    }
+    return CY_SUCCESS;
+}
+
+CY_RETURN_STATUS
+cyusb_jtag_enable(struct cyusb_dev *dev) {
+    return CyJtagEnable(dev->handle);
+}
+
+CY_RETURN_STATUS
+cyusb_jtag_disable(struct cyusb_dev *dev) {
+    return CyJtagDisable(dev->handle);
+}
+
+//
+// Each segment writes tx (if any) with CyJtagWrite(), then reads
+// len bytes into rx (if any) with CyJtagRead().
+//
+CY_RETURN_STATUS
+cyusb_jtag_xfer(struct cyusb_dev *dev,
+                struct cyusb_iov *iov, int nr, uint32_t timeout) {
+    for (int i = 0; i < nr; i++) {
+        CY_RETURN_STATUS rc;
+
+        iov[i].count = 0;
+
+        if (iov[i].tx) {
+            CY_DATA_BUFFER wb = { .buffer = (UCHAR *)iov[i].tx, .length = iov[i].len };
+
+            rc = CyJtagWrite(dev->handle, &wb, timeout);
+            iov[i].count = wb.transferCount;
+            if (rc != CY_SUCCESS) {
+                return rc;
+            }
+        }
+
+        if (iov[i].rx) {
+            CY_DATA_BUFFER rb = { .buffer = iov[i].rx, .length = iov[i].len };
+
+            rc = CyJtagRead(dev->handle, &rb, timeout);
+            iov[i].count = rb.transferCount;
+            if (rc != CY_SUCCESS) {
+                return rc;
+            }
+        }
+    }
+    return CY_SUCCESS;
+}
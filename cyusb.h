@@ -0,0 +1,122 @@
+#ifndef CYUSB_H
+#define CYUSB_H
+
+//
+// Library interface to Cypress USB-Serial bridges.
+//
+// All buffers are owned by the caller and handed to cyusbserial
+// as-is. Nothing here allocates memory or prints anything: every
+// call reports through its CY_RETURN_STATUS.
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include "CyUSBSerial.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CYUSB_DEFAULT_VID 0x04B4
+#define CYUSB_DEFAULT_PID 0x0004
+
+//
+// Which serial block to open: <index>th one matching all of
+//
+// - vid:pid
+// - block: SCB0 or SCB1 of dual-channel parts (-1: any)
+// - ifnum: USB interface number, Linux only (-1: any)
+// - type:  configured function (CY_TYPE_DISABLED: any)
+//
+// If no block has the wanted type, type is ignored.
+//
+// index counts devices: the first matching block of each device is
+// taken. On Windows every serial block is a device of its own, so
+// there index counts blocks; set block to pin one.
+//
+struct cyusb_selector {
+    int vid, pid;
+    int index;
+    int block, ifnum;
+    CY_DEVICE_TYPE type;
+};
+
+struct cyusb_dev {
+    CY_HANDLE handle;
+    int devnum, ifnum;
+    int block;
+};
+
+//
+// One segment of a scatter/gather transfer. Either of tx/rx may be
+// NULL. count is set to the number of bytes actually transferred.
+//
+struct cyusb_iov {
+    const uint8_t *tx;
+    uint8_t *rx;
+    uint32_t len;
+    uint32_t count;
+};
+
+extern const char *
+cyusb_type_s(CY_DEVICE_TYPE dt);
+
+extern const char *
+cyusb_class_s(CY_DEVICE_CLASS dc);
+
+extern void
+cyusb_scan(void (*scan)(CY_DEVICE_INFO *, void *), void *data);
+
+extern void
+cyusb_selector_init(struct cyusb_selector *sel);
+
+extern CY_RETURN_STATUS
+cyusb_open(struct cyusb_dev *dev, const struct cyusb_selector *sel);
+
+// Clears dev->handle, even if CyClose() fails
+extern CY_RETURN_STATUS
+cyusb_close(struct cyusb_dev *dev);
+
+extern int
+cyusb_parse_spi_config(const char *spec, CY_SPI_CONFIG *cfg);
+
+extern int
+cyusb_parse_i2c_config(const char *spec, CY_I2C_CONFIG *cfg);
+
+extern int
+cyusb_parse_i2c_data_config(const char *spec, CY_I2C_DATA_CONFIG *dc);
+
+extern CY_RETURN_STATUS
+cyusb_spi_configure(struct cyusb_dev *dev, CY_SPI_CONFIG *cfg);
+
+extern CY_RETURN_STATUS
+cyusb_spi_xfer(struct cyusb_dev *dev,
+               struct cyusb_iov *iov, int nr, uint32_t timeout);
+
+extern CY_RETURN_STATUS
+cyusb_i2c_configure(struct cyusb_dev *dev, CY_I2C_CONFIG *cfg);
+
+extern CY_RETURN_STATUS
+cyusb_i2c_xfer(struct cyusb_dev *dev, const CY_I2C_DATA_CONFIG *dc,
+               struct cyusb_iov *iov, int nr, uint32_t timeout);
+
+extern CY_RETURN_STATUS
+cyusb_jtag_enable(struct cyusb_dev *dev);
+
+extern CY_RETURN_STATUS
+cyusb_jtag_disable(struct cyusb_dev *dev);
+
+extern CY_RETURN_STATUS
+cyusb_jtag_xfer(struct cyusb_dev *dev,
+                struct cyusb_iov *iov, int nr, uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif